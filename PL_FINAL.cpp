@@ -9,6 +9,46 @@
 #include <vector>
 #include <stack>
 #include <utility>
+#include <sstream>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cctype>
+#include <cstring>
+#include <functional>
+#include <deque>
+#include <filesystem>
+#include <cstdint>
+#include <climits>
+#include <limits>
+#include <cerrno>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <csignal>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define PL_COMPUTED_GOTO
+#endif
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#define PSAPI_VERSION 2
+#include <windows.h>
+#include <psapi.h>
+#include <conio.h>
+#include <io.h>
+#ifndef ENABLE_VIRTUAL_TERMINAL_PROCESSING
+#define ENABLE_VIRTUAL_TERMINAL_PROCESSING 0x0004
+#endif
+#else
+#include <sys/resource.h>
+#include <termios.h>
+#include <unistd.h>
+#include <poll.h>
+#endif
 
 using namespace std;
 
@@ -30,35 +70,415 @@ struct Node {
 };
 
 
+// Instruction set of the stack machine used in Phase 4. The order must match
+// the dispatch table in runBytecode() and opNames in programCompilation().
+enum OpCode {
+    OP_PUSH,        // push constants[operand]
+    OP_LOAD,        // push slots[operand]
+    OP_STORE,       // pop into slots[operand]
+    OP_STORE_INT,   // pop an integer, wrap it to 32 bits, store into slots[operand]
+    OP_TRUNC_INT,   // truncate a double to int, error if out of range
+    OP_TO_DOUBLE,   // convert the integer operand values below the top to double
+    OP_ADD,         // double arithmetic
+    OP_SUB,
+    OP_MUL,
+    OP_DIV,
+    OP_IDIV,        // integer division, operand 1 when both operands are int
+    OP_MOD,         // integer remainder, operand as for OP_IDIV
+    OP_NEG,
+    OP_IADD,        // int arithmetic, wraps to 32 bits like g++
+    OP_ISUB,
+    OP_IMUL,
+    OP_INEG,
+    OP_LADD,        // long arithmetic, error on 64-bit overflow
+    OP_LSUB,
+    OP_LMUL,
+    OP_LNEG,
+    OP_PRINT,       // pop and print as double
+    OP_PRINT_INT,   // pop and print as an integer
+    OP_PRINT_STR,   // print strings[operand]
+    OP_READ,        // cin >> slots[operand] (double)
+    OP_READ_INT,    // cin >> slots[operand] (int)
+    OP_HALT         // pop the exit code and stop
+};
+
+// Stack and variable cell. The compiler knows the static type of every
+// value, so each instruction reads the member that was written: i for int
+// and long, d for double.
+union Value {
+    long long i;
+    double d;
+};
+
+struct Instruction {
+    OpCode op;
+    int operand;
+};
+
+struct Bytecode {
+    vector<Instruction> code;
+    vector<Value> constants;
+    vector<bool> constantIsInt;
+    vector<string> strings;
+    vector<string> slotNames;
+    vector<bool> slotIsInt;
+    int maxStack = 0;
+};
+
+
+// Limit in bytes for the compiler's token stream kept in memory, 0 means
+// unlimited. Tokens beyond the limit are moved to a SpillSegment.
+size_t memoryBudget = 0;
+size_t spilledBytes = 0;
+
+
+// Temporary file holding data evicted from memory once the memory budget is
+// exceeded. Records are length-prefixed strings written and read back in the
+// same order through separate streams, so neither side ever seeks. The file
+// is deleted when the segment is closed or destroyed. Once an operation
+// fails, failed stays set and every later call returns false.
+struct SpillSegment {
+    string path;
+    ofstream writer;
+    ifstream reader;
+    bool unflushed = false;
+    bool failed = false;
+
+    ~SpillSegment() { close(); }
+
+    bool write(const string& record) {
+        if (failed) return false;
+        if (!writer.is_open()) {
+            static int counter = 0;
+            error_code error;
+            filesystem::path directory = filesystem::temp_directory_path(error);
+            if (error) directory = ".";
+            string name = "pl_spill_" + to_string(chrono::steady_clock::now().time_since_epoch().count()) + "_" + to_string(counter++) + ".tmp";
+            path = (directory / name).string();
+            writer.open(path, ios::binary | ios::trunc);
+        }
+        uint64_t length = record.length();
+        writer.write((const char*)&length, sizeof(length));
+        writer.write(record.data(), record.length());
+        if (!writer) {
+            failed = true;
+            return false;
+        }
+        unflushed = true;
+        spilledBytes += sizeof(length) + record.length();
+        return true;
+    }
+
+    // Reads the next record in the order they were written.
+    bool read(string& record) {
+        if (failed) return false;
+        if (unflushed) {
+            unflushed = false;
+            if (!writer.flush()) {
+                failed = true;
+                return false;
+            }
+        }
+        if (!reader.is_open()) reader.open(path, ios::binary);
+        // The reader may have hit end of file before more records were written
+        reader.clear();
+        uint64_t length = 0;
+        if (!reader.read((char*)&length, sizeof(length))) {
+            failed = true;
+            return false;
+        }
+        record.resize(length);
+        if (length > 0 && !reader.read(&record[0], length)) {
+            failed = true;
+            return false;
+        }
+        return true;
+    }
+
+    void close() {
+        if (!writer.is_open()) return;
+        writer.close();
+        reader.close();
+        remove(path.c_str());
+    }
+};
+
+
+// (type, value) tokens for the bytecode compiler. Tokens are kept in memory
+// while they fit in the memory budget; the rest wait in a spill segment and
+// are read back in order as the compiler releases the ones it has processed.
+// If the segment fails, failed is set and the stream behaves as if it ended.
+struct TokenStream {
+    deque<pair<string, string>> window;   // tokens [first, first + window.size())
+    size_t first = 0;
+    size_t count = 0;
+    size_t windowBytes = 0;
+    size_t onDisk = 0;
+    bool failed = false;
+    SpillSegment segment;
+
+    static size_t cost(const pair<string, string>& token) {
+        return sizeof(token) + token.first.length() + token.second.length();
+    }
+
+    size_t size() const { return failed ? 0 : count; }
+
+    void push_back(pair<string, string> token) {
+        if (failed) return;
+        size_t bytes = cost(token);
+        if (onDisk == 0 && (memoryBudget == 0 || windowBytes + bytes <= memoryBudget)) {
+            windowBytes += bytes;
+            window.push_back(move(token));
+        }
+        else if (segment.write(token.first) && segment.write(token.second)) {
+            onDisk++;
+        }
+        else {
+            failed = true;
+            return;
+        }
+        count++;
+    }
+
+    const pair<string, string>& operator[](size_t index) {
+        static const pair<string, string> endOfStream;
+        // Reload from disk until index is in the window, then keep filling
+        // while there is room in the budget.
+        while (!failed && onDisk > 0 && (index >= first + window.size() || memoryBudget == 0 || windowBytes < memoryBudget)) {
+            pair<string, string> token;
+            if (!segment.read(token.first) || !segment.read(token.second)) {
+                failed = true;
+                break;
+            }
+            windowBytes += cost(token);
+            window.push_back(move(token));
+            onDisk--;
+        }
+        if (failed || index < first || index >= first + window.size()) {
+            failed = true;
+            return endOfStream;
+        }
+        return window[index - first];
+    }
+
+    // Drops every token before index, the compiler never looks back at them.
+    void release(size_t index) {
+        while (first < index && !window.empty()) {
+            windowBytes -= cost(window.front());
+            window.pop_front();
+            first++;
+        }
+    }
+};
+
+
+// Shared with the worker thread that runs the analysis. Each phase reports
+// how much of analysisTotal it has done in analysisProgress (bytes of the
+// file, tokens or instructions) and stops at the next line, token or
+// instruction once cancelRequested is set.
+atomic<bool> cancelRequested(false);
+atomic<int> analysisPhase(0);
+atomic<size_t> analysisProgress(0);
+atomic<size_t> analysisTotal(0);
+
+
+// Stream buffer installed on cout while the analysis runs on the worker
+// thread. Output is forwarded in chunks under a mutex so that the UI thread
+// can draw a status line below it, which is erased before more output.
+class ConsoleBuffer : public streambuf {
+public:
+    explicit ConsoleBuffer(streambuf* output) : target(output) {
+        setp(buffer, buffer + sizeof(buffer));
+    }
+
+    ~ConsoleBuffer() {
+        sync();
+        clearStatus();
+    }
+
+    void showStatus(const string& text) {
+        lock_guard<mutex> lock(guard);
+        if (!atLineStart) return;
+        string line = "\r\x1b[2K" + text;
+        target->sputn(line.data(), line.length());
+        target->pubsync();
+        statusShown = true;
+    }
+
+    void clearStatus() {
+        lock_guard<mutex> lock(guard);
+        eraseStatus();
+        target->pubsync();
+    }
+
+protected:
+    int overflow(int ch) override {
+        flushBuffer(false);
+        if (ch != EOF) {
+            *pptr() = (char)ch;
+            pbump(1);
+        }
+        return ch == EOF ? 0 : ch;
+    }
+
+    int sync() override {
+        flushBuffer(true);
+        return target->pubsync();
+    }
+
+private:
+    void eraseStatus() {
+        if (statusShown) target->sputn("\r\x1b[2K", 5);
+        statusShown = false;
+    }
+
+    // Writes the buffered output. Unless all is set, a partial last line
+    // stays in the buffer so that the output ends at the start of a line
+    // and the status line can be drawn after every chunk.
+    void flushBuffer(bool all) {
+        ptrdiff_t length = pptr() - pbase();
+        if (length == 0) return;
+        ptrdiff_t complete = length;
+        if (!all) {
+            char* end = pptr();
+            while (end > pbase() && end[-1] != '\n') end--;
+            if (end > pbase()) complete = end - pbase();
+        }
+        {
+            lock_guard<mutex> lock(guard);
+            eraseStatus();
+            target->sputn(pbase(), complete);
+            atLineStart = pbase()[complete - 1] == '\n';
+        }
+        memmove(pbase(), pbase() + complete, (size_t)(length - complete));
+        setp(buffer, buffer + sizeof(buffer));
+        pbump((int)(length - complete));
+    }
+
+    streambuf* target;
+    mutex guard;
+    char buffer[1 << 16];
+    bool atLineStart = true;
+    bool statusShown = false;
+};
+
+
+// Switches the terminal to unbuffered, no-echo input for as long as it
+// exists so that single key presses can be polled without blocking; this
+// is skipped when stdin is not a terminal. Ctrl-C requests a cancel instead
+// of killing the process, which would leave the terminal without echo.
+class KeyboardPoller {
+public:
+    KeyboardPoller() {
+        previousHandler = signal(SIGINT, requestCancel);
+#ifdef _WIN32
+        active = _isatty(_fileno(stdin)) != 0;
+#else
+        active = isatty(STDIN_FILENO) && tcgetattr(STDIN_FILENO, &saved) == 0;
+        if (active) {
+            termios raw = saved;
+            raw.c_lflag &= ~(ICANON | ECHO);
+            raw.c_cc[VMIN] = 0;
+            raw.c_cc[VTIME] = 0;
+            tcsetattr(STDIN_FILENO, TCSANOW, &raw);
+        }
+#endif
+    }
+
+    ~KeyboardPoller() {
+#ifndef _WIN32
+        if (active) tcsetattr(STDIN_FILENO, TCSANOW, &saved);
+#endif
+        if (previousHandler != SIG_ERR) signal(SIGINT, previousHandler);
+    }
+
+    // Waits up to milliseconds for a key and returns it, or -1.
+    int poll(int milliseconds) {
+        if (!active) {
+            this_thread::sleep_for(chrono::milliseconds(milliseconds));
+            return -1;
+        }
+#ifdef _WIN32
+        for (int waited = 0; waited < milliseconds; waited += 10) {
+            if (_kbhit()) return _getch();
+            Sleep(10);
+        }
+        return -1;
+#else
+        pollfd input = { STDIN_FILENO, POLLIN, 0 };
+        char key;
+        if (::poll(&input, 1, milliseconds) > 0 && read(STDIN_FILENO, &key, 1) == 1) return (unsigned char)key;
+        return -1;
+#endif
+    }
+
+private:
+    // The Windows runtime resets the handler before calling it.
+    static void requestCancel(int) {
+        cancelRequested = true;
+        signal(SIGINT, requestCancel);
+    }
+
+    bool active = false;
+    void (*previousHandler)(int) = SIG_DFL;
+#ifndef _WIN32
+    termios saved;
+#endif
+};
+
+
 list<string> varList;
 list<Symbol> symbolList;
 
 void pressEnter();
 void inputText();
 void inputFile();
-bool lexicalAnalysis(string);
+bool lexicalAnalysis(string, bool useScanner = false);
+vector<pair<size_t, string>> regexTokenizeLine(const string& line);
+vector<pair<size_t, string>> scanTokenizeLine(const string& line);
 bool syntaxAnalysis();
 bool semanticAnalysis(string);
 Node* createParseTree(const vector<pair<string, pair<string, string>>>& input);
 void printParseTree(Node* node, int depth);
-
-
+void preOrderTraversal(Node* root, const function<void(Node*, int)>& visit, int depth = 0);
+void postOrderTraversal(Node* root, const function<void(Node*, int)>& visit, int depth = 0);
+bool programCompilation(string, Bytecode&);
+bool programExecution(const Bytecode&);
+bool compileProgram(string, Bytecode&);
+long long runBytecode(const Bytecode&, istream&, ostream*, long long&);
+void benchmarkFile();
+void setMemoryBudget();
+void deleteParseTree(Node* root);
+size_t peakMemoryUsage();
+void printMemoryReport();
+void clearScreen();
+bool stdoutIsTerminal();
+bool runAnalysis(string);
+
+
+#ifndef PL_NO_MAIN
 int main() {
 
     bool running = true;
     int option;
     while (running) {
-        system("cls");
+        clearScreen();
         symbolList.clear();
         cout << "=============================================================================" << endl;
         cout << setw(60) << "C++ Lexical, Syntax, and Semantic Analysis" << endl;
         cout << "=============================================================================" << endl << endl;
         cout << " [1] Input text" << endl;
         cout << " [2] Input from file" << endl;
-        cout << " [3] Exit program" << endl << endl;
+        cout << " [3] Benchmark execution" << endl;
+        cout << " [4] Set compiler memory budget (current: ";
+        if (memoryBudget == 0) cout << "unlimited";
+        else cout << memoryBudget / (1024 * 1024) << " MB";
+        cout << ")" << endl;
+        cout << " [5] Exit program" << endl << endl;
         cout << "=============================================================================" << endl;
         cout << " Enter option: ";
         cin >> option;
+        if (cin.eof()) break;
         cin.ignore();
         switch (option) {
         default:
@@ -72,6 +492,12 @@ int main() {
             inputFile();
             break;
         case 3:
+            benchmarkFile();
+            break;
+        case 4:
+            setMemoryBudget();
+            break;
+        case 5:
             running = false;
             break;
         }
@@ -79,8 +505,138 @@ int main() {
     
     return 0;
 }
+#endif
+
+// Splits one line into (position, lexeme) pairs with the original regular
+// expression. This is the reference engine for lexicalAnalysis().
+vector<pair<size_t, string>> regexTokenizeLine(const string& line) {
+
+    static const regex re("(using\\s+namespace\\s+std)|(std::\\b(cout|cin))|(\\b\\d+\\b)|(\".*?\")|(//[^\\n]*)|(\\b[a-zA-Z_][a-zA-Z0-9_]*\\b)|(,)|"
+        "(cout)|(\".*?\")|(cin)|(<<)|(>>)|(\\(\\))|(\\{)|([\\{\\}()<>%:;.?*\\+-/^&|~!=])|(\\[\\])|"
+        "(#include <[^>]+>)|(int)|(main)|([^\\s\"';]+)|(\\S+)");
+
+    vector<pair<size_t, string>> matches;
+    auto words_end = sregex_iterator();
+    for (sregex_iterator i = sregex_iterator(line.begin(), line.end(), re); i != words_end && !cancelRequested; ++i) {
+        matches.push_back({ (size_t)i->position(), i->str() });
+    }
+    return matches;
+}
+
+
+static bool isWordChar(char c) {
+    return isalnum((unsigned char)c) || c == '_';
+}
+
+static bool isSpaceChar(char c) {
+    return isspace((unsigned char)c) != 0;
+}
 
-bool lexicalAnalysis(string filename) {
+// Hand-written equivalent of regexTokenizeLine(). Every branch mirrors one
+// alternative of the regular expression, tried in the same order, so both
+// engines must return identical lexemes (see fuzz_analysis.cpp).
+vector<pair<size_t, string>> scanTokenizeLine(const string& line) {
+
+    vector<pair<size_t, string>> matches;
+    size_t n = line.length();
+    size_t pos = 0;
+
+    auto startsWith = [&](size_t at, const char* text) {
+        return line.compare(at, strlen(text), text) == 0;
+    };
+    auto skipSpaces = [&](size_t at) {
+        size_t from = at;
+        while (at < n && isSpaceChar(line[at])) at++;
+        return at > from ? at : string::npos;
+    };
+
+    while (pos < n && !cancelRequested) {
+        char c = line[pos];
+        if (isSpaceChar(c)) {
+            pos++;
+            continue;
+        }
+
+        bool boundaryBefore = pos == 0 || !isWordChar(line[pos - 1]);
+        size_t length = 0;
+
+        // using\s+namespace\s+std
+        if (startsWith(pos, "using")) {
+            size_t at = skipSpaces(pos + 5);
+            if (at != string::npos && startsWith(at, "namespace")) {
+                at = skipSpaces(at + 9);
+                if (at != string::npos && startsWith(at, "std")) length = at + 3 - pos;
+            }
+        }
+        // std::\b(cout|cin)
+        if (length == 0 && startsWith(pos, "std::")) {
+            if (startsWith(pos + 5, "cout")) length = 9;
+            else if (startsWith(pos + 5, "cin")) length = 8;
+        }
+        // \b\d+\b
+        if (length == 0 && boundaryBefore && isdigit((unsigned char)c)) {
+            size_t at = pos;
+            while (at < n && isdigit((unsigned char)line[at])) at++;
+            if (at == n || !isWordChar(line[at])) length = at - pos;
+        }
+        // ".*?"  ('.' does not match line terminators)
+        if (length == 0 && c == '"') {
+            for (size_t at = pos + 1; at < n && line[at] != '\r' && line[at] != '\n'; at++) {
+                if (line[at] == '"') {
+                    length = at + 1 - pos;
+                    break;
+                }
+            }
+        }
+        // //[^\n]*
+        if (length == 0 && startsWith(pos, "//")) {
+            size_t at = line.find('\n', pos);
+            length = (at == string::npos ? n : at) - pos;
+        }
+        // \b[a-zA-Z_][a-zA-Z0-9_]*\b
+        if (length == 0 && boundaryBefore && (isalpha((unsigned char)c) || c == '_')) {
+            size_t at = pos;
+            while (at < n && isWordChar(line[at])) at++;
+            length = at - pos;
+        }
+        if (length == 0) {
+            if (c == ',') length = 1;
+            else if (startsWith(pos, "cout")) length = 4;
+            else if (startsWith(pos, "cin")) length = 3;
+            else if (startsWith(pos, "<<") || startsWith(pos, ">>") || startsWith(pos, "()")) length = 2;
+            else if (c != '\0' && strchr("{}()<>%:;.?*+,-./^&|~!=", c) != nullptr) length = 1;
+            else if (startsWith(pos, "[]")) length = 2;
+        }
+        // #include <[^>]+>
+        if (length == 0 && startsWith(pos, "#include <")) {
+            size_t at = line.find('>', pos + 10);
+            if (at != string::npos && at > pos + 10) length = at + 1 - pos;
+        }
+        if (length == 0) {
+            if (startsWith(pos, "int")) length = 3;
+            else if (startsWith(pos, "main")) length = 4;
+        }
+        // [^\s"';]+ and finally \S+
+        if (length == 0) {
+            size_t at = pos;
+            if (c != '"' && c != '\'' && c != ';') {
+                while (at < n && !isSpaceChar(line[at]) && line[at] != '"' && line[at] != '\'' && line[at] != ';') at++;
+            }
+            else {
+                while (at < n && !isSpaceChar(line[at])) at++;
+            }
+            length = at - pos;
+        }
+
+        matches.push_back({ pos, line.substr(pos, length) });
+        pos += length;
+    }
+
+    return matches;
+}
+
+
+bool lexicalAnalysis(string filename, bool useScanner) {
     
     ifstream file(filename);
     varList.clear();
@@ -94,29 +650,31 @@ bool lexicalAnalysis(string filename) {
     cout << "=============================================================================" << endl << endl;
     string line;
 
-    // Regular expression 
-    regex re("(using\\s+namespace\\s+std)|(std::\\b(cout|cin))|(\\b\\d+\\b)|(\".*?\")|(//[^\\n]*)|(\\b[a-zA-Z_][a-zA-Z0-9_]*\\b)|(,)|"
-        "(cout)|(\".*?\")|(cin)|(<<)|(>>)|(\\(\\))|(\\{)|([\\{\\}()<>%:;.?*\\+-/^&|~!=])|(\\[\\])|"
-        "(#include <[^>]+>)|(int)|(main)|([^\\s\"';]+)|(\\S+)");
-
+    size_t lineStart = 0;
     while (getline(file, line)) {
-        auto words_begin = sregex_iterator(line.begin(), line.end(), re);
-        auto words_end = sregex_iterator();
+        if (cancelRequested) {
+            return false;
+        }
+        vector<pair<size_t, string>> matches = useScanner ? scanTokenizeLine(line) : regexTokenizeLine(line);
+        size_t words_end = matches.size();
 
-        for (sregex_iterator i = words_begin; i != words_end; ++i) {
-            smatch match = *i;
-            string match_str = match.str();
+        for (size_t i = 0; i < words_end; ++i) {
+            if (cancelRequested) {
+                return false;
+            }
+            analysisProgress = lineStart + matches[i].first;
+            string match_str = matches[i].second;
 
             if (match_str == "cout" || match_str == "cin") {
                 cout << "Token(Type: " << tokenTypes[match_str] << ", Value: '" << match_str << "')\n";
-                while (i != words_end) {
+                while (i < words_end) {
                     ++i;
                     if (i == words_end) {
                         cout << "Error: Missing tokens after '" << match_str << "'\n";
                         break;
                     }
 
-                    match_str = (*i).str();
+                    match_str = matches[i].second;
                     if (match_str == "<<" || match_str == ">>") {
                         cout << "Token(Type: " << tokenTypes[match_str] << ", Value: '" << match_str << "')\n";
                         continue;
@@ -128,9 +686,8 @@ bool lexicalAnalysis(string filename) {
                     cout << "Token(Type: STRING_LITERAL" << ": \"" << match_str << "\")" << endl;
 
                     // If the next token is not '<<' or '>>', break the loop
-                    sregex_iterator next = i;
-                    ++next;
-                    if (next == words_end || ((*next).str() != "<<" && (*next).str() != ">>")) {
+                    size_t next = i + 1;
+                    if (next == words_end || (matches[next].second != "<<" && matches[next].second != ">>")) {
                         break;
                     }
                 }
@@ -142,7 +699,7 @@ bool lexicalAnalysis(string filename) {
                 cout << "Token(Type: " << tokenTypes[match_str] << ", Value: '" << match_str << "')\n";
             }
             else if (match_str[0] == '/' && match_str[1] == '/') {
-                string comment = line.substr(i->position());
+                string comment = line.substr(matches[i].first);
                 cout << "Token(Type: COMMENT, Value: \"" << comment << "\")\n";
                 break;
             }
@@ -152,6 +709,8 @@ bool lexicalAnalysis(string filename) {
                 return false;
             }
         }
+        lineStart += line.length() + 1;
+        analysisProgress = lineStart;
     }
 
     
@@ -177,6 +736,7 @@ bool syntaxAnalysis() {
 
     Node* parseTree = createParseTree(fList);
     printParseTree(parseTree,1);
+    deleteParseTree(parseTree);
 
 
 
@@ -205,31 +765,51 @@ bool semanticAnalysis(string filename) {
     string line;
 
 
-    regex re("(\\b(void|int|string|float|char|bool|double)\\s+\\w+(,*\\s*\\w+)*\\s*(\\(\\))?)|(return\\s+\"?\\w+\"?)");
+    // Built once; constructing a regex costs far more than matching a line.
+    static const regex re("(\\b(void|int|string|float|char|bool|double)\\s+\\w+(,*\\s*\\w+)*\\s*(\\(\\))?)|(return\\s+\"?\\w+\"?)");
+    static const regex includeIO("#include\\s+<\\s*iostream\\s*>");
+    static const regex usingNamespace("using\\s+namespace\\s+std;");
+    static const regex coutWord("cout");
+    static const regex stdCout("std::cout");
+    static const regex coutOp("cout\\s+<<");
+    static const regex stdCoutOp("std::cout\\s+<<");
+    static const regex cinWord("cin");
+    static const regex stdCin("std::cin");
+    static const regex cinOp("cin\\s+>>");
+    static const regex stdCinOp("std::cin\\s+>>");
+    static const regex returnStatement("(return\\s+\"?\\w+\"?)");
+    static const regex invalidIntReturn("\\b(true|false)|(\"\\w+\")|(\\d+\\.\\d+)");
+    static const regex anyReturnValue("\"?\\w+\"?");
+    static const regex arithmetic("(\\w+\\s*[+\\-*\\/\\%]\\s*\\w+)");
+    static const regex opRegex("\\w+");
 
     while (getline(file, line)) {
-        if (regex_search(line, regex("#include\\s+<\\s*iostream\\s*>"))) {
+        analysisProgress += line.length() + 1;
+        if (cancelRequested) {
+            return false;
+        }
+        if (regex_search(line, includeIO)) {
             usingIO = true;
         }
-        if (regex_search(line, regex("using\\s+namespace\\s+std;"))) {
+        if (regex_search(line, usingNamespace)) {
             usingStd = true;
         }
-        if (regex_search(line,regex("cout"))) {
+        if (regex_search(line, coutWord)) {
            if (!usingIO) {
                validIOUse = false;
-           } else if (!usingStd && !regex_search(line, regex("std::cout"))) {
+           } else if (!usingStd && !regex_search(line, stdCout)) {
                validStdUse = false;
-           } else if (!regex_search(line, regex("cout\\s+<<")) || (!usingStd && !regex_search(line, regex("std::cout\\s+<<")))) {
+           } else if (!regex_search(line, coutOp) || (!usingStd && !regex_search(line, stdCoutOp))) {
                validOp = false;
            }
         }
 
-        if (regex_search(line, regex("cin"))) {
+        if (regex_search(line, cinWord)) {
             if (!usingIO) {
                 validIOUse = false;
-            }else if (!usingStd && !regex_search(line, regex("std::cin"))) {
+            }else if (!usingStd && !regex_search(line, stdCin)) {
                 validStdUse = false;
-            }else if (!regex_search(line, regex("cin\\s+>>")) || (!usingStd && !regex_search(line, regex("std::cin\\s+>>")))) {
+            }else if (!regex_search(line, cinOp) || (!usingStd && !regex_search(line, stdCinOp))) {
                 validOp = false;
             }
         }
@@ -238,13 +818,16 @@ bool semanticAnalysis(string filename) {
         auto words_end = sregex_iterator();
         
         for (sregex_iterator i = words_begin; i != words_end; ++i) {
+            if (cancelRequested) {
+                return false;
+            }
             smatch match = *i;
             string match_str = match.str();
             Symbol symbol;
 
             bool isReturnType = false;
             string returntype = "";
-            if (regex_search(match_str, regex("(return\\s+\"?\\w+\"?)"))) {
+            if (regex_search(match_str, returnStatement)) {
                 for (int i = 0; i < match_str.length(); i++) {
                     if (match_str[i] == ' ') {
                         isReturnType = true;
@@ -257,14 +840,14 @@ bool semanticAnalysis(string filename) {
                 for (auto it = symbolList.begin(); it != symbolList.end(); ++it) {
                     if (it->name == "main" && it->type!="void") {
                         if (it->type == "int") {
-                            if (regex_search(returntype, regex("\\b(true|false)|(\"\\w+\")|(\\d+\\.\\d+)"))) {
+                            if (regex_search(returntype, invalidIntReturn)) {
                                 validReturn = false;
                             }
                         }
                         
                     }
                     else if (it->name == "main" && it->type == "void") {
-                        if (regex_search(returntype, regex("\"?\\w+\"?"))) {
+                        if (regex_search(returntype, anyReturnValue)) {
                             validReturn = false;
                         }
                     }
@@ -402,20 +985,27 @@ bool semanticAnalysis(string filename) {
 
     cout << endl;
     file.open(filename);
-    string operation = "";
     bool compatibleType = true;
     while (getline(file, line)) {
-        if (regex_search(line, regex("(\\w+\\s*[+\\-*\\/\\%]\\s*\\w+)"))) {
+        analysisProgress += line.length() + 1;
+        if (cancelRequested) {
+            return false;
+        }
+        if (regex_search(line, arithmetic)) {
+            // Each line is checked as one operation on its own
+            string operation = "";
             for (int i = 0; i < line.length(); i++) {
                 if (line[i] == ' ' || line[i] == ';') continue;
                 operation += line[i];
             }
-            regex opRegex("\\w+");
             auto words_begin = sregex_iterator(operation.begin(), operation.end(), opRegex);
             auto words_end = sregex_iterator();
             
             string checkType = "";
             for (sregex_iterator i = words_begin; i != words_end; ++i) {
+                if (cancelRequested) {
+                    return false;
+                }
                 smatch match = *i;
                 string match_str = match.str();
                 for (auto it = symbolList.begin(); it != symbolList.end(); ++it) {
@@ -473,8 +1063,801 @@ bool semanticAnalysis(string filename) {
 }
 
 
+// First half of Phase 4: compiles the file and prints the bytecode listing.
+// Runs on the analysis worker thread.
+bool programCompilation(string filename, Bytecode& program) {
+
+    cout << endl << "=============================================================================" << endl;
+    cout << setw(51) << " Phase 4: Execution" << endl;
+    cout << "=============================================================================" << endl << endl;
+
+    if (!compileProgram(filename, program)) {
+        return false;
+    }
+
+    cout << "[Bytecode]" << endl << endl;
+    analysisProgress = 0;
+    analysisTotal = program.code.size();
+    const char* opNames[] = { "PUSH", "LOAD", "STORE", "STORE_INT", "TRUNC_INT", "TO_DOUBLE", "ADD", "SUB", "MUL", "DIV",
+        "IDIV", "MOD", "NEG", "IADD", "ISUB", "IMUL", "INEG", "LADD", "LSUB", "LMUL", "LNEG", "PRINT", "PRINT_INT",
+        "PRINT_STR", "READ", "READ_INT", "HALT" };
+    for (size_t i = 0; i < program.code.size(); i++) {
+        if (cancelRequested) {
+            return false;
+        }
+        analysisProgress = i;
+        const Instruction& ins = program.code[i];
+        cout << setw(6) << i << "  " << left << setw(12) << opNames[ins.op] << right;
+        if (ins.op == OP_PUSH && program.constantIsInt[ins.operand]) cout << program.constants[ins.operand].i;
+        else if (ins.op == OP_PUSH) cout << program.constants[ins.operand].d;
+        else if (ins.op == OP_TO_DOUBLE) cout << ins.operand;
+        else if (ins.op == OP_PRINT_STR) cout << "#" << ins.operand;
+        else if (ins.op == OP_LOAD || ins.op == OP_STORE || ins.op == OP_STORE_INT || ins.op == OP_READ || ins.op == OP_READ_INT)
+            cout << program.slotNames[ins.operand];
+        cout << '\n';
+    }
+
+    return true;
+}
+
+
+// Second half of Phase 4: runs the program. Stays on the main thread
+// because the program reads from cin.
+bool programExecution(const Bytecode& program) {
+
+    cout << endl << "[Program Output]" << endl << endl;
+
+    long long executed = 0;
+    auto start = chrono::steady_clock::now();
+    long long exitCode = runBytecode(program, cin, &cout, executed);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    // The menu reads from the same cin. The code has no jumps, so the first
+    // executed instructions show whether the program read input; if so,
+    // drop what is left of its line, including input that failed to parse.
+    bool readInput = false;
+    for (size_t i = 0; i < program.code.size() && (long long)i < executed; i++) {
+        if (program.code[i].op == OP_READ || program.code[i].op == OP_READ_INT) readInput = true;
+    }
+    cin.clear();
+    if (readInput) cin.ignore(numeric_limits<streamsize>::max(), '\n');
+
+    cout << endl << endl << "Program exited with code " << exitCode << " after " << executed << " instructions";
+    cout << " (" << fixed << setprecision(3) << seconds * 1000 << " ms)." << endl;
+    cout.unsetf(ios::floatfield);
+    cout << setprecision(6);
+
+    return true;
+}
+
+
+// Splits the source into (type, value) pairs for the bytecode compiler.
+// Preprocessor lines and comments are skipped; "std::" prefixes are dropped.
+bool tokenizeProgram(string filename, TokenStream& tokens) {
+
+    ifstream file(filename);
+    if (!file.is_open()) {
+        cout << "Error: Unable to open file." << endl;
+        return false;
+    }
+
+    string line;
+    while (getline(file, line)) {
+        analysisProgress += line.length() + 1;
+        if (tokens.failed) {
+            cout << "Error: unable to write the spill file for the token stream." << endl;
+            return false;
+        }
+        size_t i = 0;
+        while (i < line.length() && isspace((unsigned char)line[i])) i++;
+        if (i < line.length() && line[i] == '#') continue;
+
+        while (i < line.length()) {
+            if (cancelRequested) {
+                return false;
+            }
+            char c = line[i];
+            if (isspace((unsigned char)c)) {
+                i++;
+            }
+            else if (c == '/' && i + 1 < line.length() && line[i + 1] == '/') {
+                break;
+            }
+            else if (isalpha((unsigned char)c) || c == '_') {
+                size_t start = i;
+                while (i < line.length() && (isalnum((unsigned char)line[i]) || line[i] == '_')) i++;
+                string word = line.substr(start, i - start);
+                if (word == "std" && line.compare(i, 2, "::") == 0) {
+                    i += 2;
+                    continue;
+                }
+                tokens.push_back({ "IDENTIFIER", word });
+            }
+            else if (isdigit((unsigned char)c) || (c == '.' && i + 1 < line.length() && isdigit((unsigned char)line[i + 1]))) {
+                size_t start = i;
+                bool isFloat = false;
+                while (i < line.length() && (isdigit((unsigned char)line[i]) || line[i] == '.')) {
+                    if (line[i] == '.') isFloat = true;
+                    i++;
+                }
+                if (i < line.length() && (line[i] == 'e' || line[i] == 'E')) {
+                    size_t digits = i + 1;
+                    if (digits < line.length() && (line[digits] == '+' || line[digits] == '-')) digits++;
+                    if (digits < line.length() && isdigit((unsigned char)line[digits])) {
+                        i = digits;
+                        while (i < line.length() && isdigit((unsigned char)line[i])) i++;
+                        isFloat = true;
+                    }
+                }
+                tokens.push_back({ isFloat ? "FLOAT_LITERAL" : "INTEGER_LITERAL", line.substr(start, i - start) });
+            }
+            else if (c == '"') {
+                string literal = "";
+                i++;
+                while (i < line.length() && line[i] != '"') {
+                    if (line[i] == '\\' && i + 1 < line.length()) {
+                        i++;
+                        switch (line[i]) {
+                        case 'n': literal += '\n'; break;
+                        case 't': literal += '\t'; break;
+                        default: literal += line[i]; break;
+                        }
+                    }
+                    else {
+                        literal += line[i];
+                    }
+                    i++;
+                }
+                if (i >= line.length()) {
+                    cout << "Error: unterminated string literal." << endl;
+                    return false;
+                }
+                i++;
+                tokens.push_back({ "STRING", literal });
+            }
+            else if ((c == '<' || c == '>') && i + 1 < line.length() && line[i + 1] == c) {
+                tokens.push_back({ "SYMBOL", line.substr(i, 2) });
+                i += 2;
+            }
+            else {
+                tokens.push_back({ "SYMBOL", string(1, c) });
+                i++;
+            }
+        }
+    }
+
+    if (tokens.failed) {
+        cout << "Error: unable to write the spill file for the token stream." << endl;
+        return false;
+    }
+
+    return true;
+}
+
+
+// Recursive descent over the token list, emitting stack machine code.
+// Each expression reports whether its static type is int so that division,
+// modulo, printing and stores can pick the matching instruction.
+struct ProgramCompiler {
+    // Static type of an expression. int is 32 bits and wraps like g++;
+    // integer literals that do not fit in an int are long.
+    enum ValueType { TYPE_INT, TYPE_LONG, TYPE_DOUBLE };
+
+    TokenStream& tokens;
+    Bytecode& program;
+    map<string, int> slots;
+    size_t pos = 0;
+    int depth = 0;
+    int nesting = 0;
+
+    ProgramCompiler(TokenStream& t, Bytecode& p) : tokens(t), program(p) {}
+
+    bool atEnd() { return pos >= tokens.size(); }
+    // String literals are never operators or keywords, so peek() and
+    // accept() do not match their text.
+    string peek() { return atEnd() || tokens[pos].first == "STRING" ? "" : tokens[pos].second; }
+    string found() {
+        if (atEnd()) return "end of file";
+        return tokens[pos].first == "STRING" ? "\"" + tokens[pos].second + "\"" : tokens[pos].second;
+    }
+    bool accept(const string& value) {
+        if (!atEnd() && tokens[pos].first != "STRING" && tokens[pos].second == value) {
+            pos++;
+            return true;
+        }
+        return false;
+    }
+    bool expect(const string& value) {
+        if (accept(value)) return true;
+        cout << "Error: expected '" << value << "' but found '" << found() << "'." << endl;
+        return false;
+    }
+
+    void emit(OpCode op, int operand = 0) {
+        program.code.push_back({ op, operand });
+        // Unary operators, PRINT_STR and the reads leave the stack depth
+        // unchanged; binary operators pop two values and push one.
+        if (op == OP_PUSH || op == OP_LOAD) depth++;
+        else if (op != OP_NEG && op != OP_INEG && op != OP_LNEG && op != OP_TRUNC_INT && op != OP_TO_DOUBLE &&
+                 op != OP_PRINT_STR && op != OP_READ && op != OP_READ_INT) depth--;
+        if (depth > program.maxStack) program.maxStack = depth;
+    }
+
+    int constant(double value) {
+        Value cell;
+        cell.d = value;
+        program.constants.push_back(cell);
+        program.constantIsInt.push_back(false);
+        return (int)program.constants.size() - 1;
+    }
+
+    int constant(long long value) {
+        Value cell;
+        cell.i = value;
+        program.constants.push_back(cell);
+        program.constantIsInt.push_back(true);
+        return (int)program.constants.size() - 1;
+    }
+
+    bool lookup(const string& name, int& slot) {
+        auto it = slots.find(name);
+        if (it == slots.end()) {
+            cout << "Error: undeclared variable '" << name << "'." << endl;
+            return false;
+        }
+        slot = it->second;
+        return true;
+    }
+
+    static ValueType common(ValueType left, ValueType right) {
+        return left > right ? left : right;
+    }
+
+    // Converts the integer operands of a binary operator to double when
+    // the other operand is a double.
+    void promote(ValueType left, ValueType right) {
+        if (left == right) return;
+        if (right != TYPE_DOUBLE && left == TYPE_DOUBLE) emit(OP_TO_DOUBLE, 0);
+        if (left != TYPE_DOUBLE && right == TYPE_DOUBLE) emit(OP_TO_DOUBLE, 1);
+    }
+
+    bool factor(ValueType& type) {
+        if (atEnd()) {
+            cout << "Error: unexpected end of file in expression." << endl;
+            return false;
+        }
+        if (++nesting > 1000) {
+            cout << "Error: expression nested too deeply." << endl;
+            return false;
+        }
+        bool ok = true;
+        pair<string, string> token = tokens[pos];
+        if (token.first == "INTEGER_LITERAL") {
+            pos++;
+            errno = 0;
+            unsigned long long value = strtoull(token.second.c_str(), nullptr, 10);
+            if (errno == ERANGE || value > 9223372036854775807ULL) {
+                cout << "Error: integer literal '" << token.second << "' is too large." << endl;
+                ok = false;
+            }
+            else {
+                type = value <= 2147483647ULL ? TYPE_INT : TYPE_LONG;
+                emit(OP_PUSH, constant((long long)value));
+            }
+        }
+        else if (token.first == "FLOAT_LITERAL") {
+            pos++;
+            type = TYPE_DOUBLE;
+            emit(OP_PUSH, constant(strtod(token.second.c_str(), nullptr)));
+        }
+        else if (token.first == "IDENTIFIER" && (token.second == "true" || token.second == "false")) {
+            pos++;
+            type = TYPE_INT;
+            emit(OP_PUSH, constant(token.second == "true" ? 1LL : 0LL));
+        }
+        else if (token.first == "IDENTIFIER") {
+            int slot;
+            pos++;
+            ok = lookup(token.second, slot);
+            if (ok) {
+                type = program.slotIsInt[slot] ? TYPE_INT : TYPE_DOUBLE;
+                emit(OP_LOAD, slot);
+            }
+        }
+        else if (accept("(")) {
+            ok = expression(type) && expect(")");
+        }
+        else if (accept("-")) {
+            ok = factor(type);
+            if (ok) emit(type == TYPE_INT ? OP_INEG : type == TYPE_LONG ? OP_LNEG : OP_NEG);
+        }
+        else if (accept("+")) {
+            ok = factor(type);
+        }
+        else {
+            cout << "Error: unexpected token '" << found() << "' in expression." << endl;
+            ok = false;
+        }
+        nesting--;
+        return ok;
+    }
+
+    bool term(ValueType& type) {
+        if (!factor(type)) return false;
+        while (peek() == "*" || peek() == "/" || peek() == "%") {
+            string op = tokens[pos++].second;
+            ValueType right;
+            if (!factor(right)) return false;
+            ValueType result = common(type, right);
+            promote(type, right);
+            if (op == "*") emit(result == TYPE_INT ? OP_IMUL : result == TYPE_LONG ? OP_LMUL : OP_MUL);
+            else if (op == "/" && result == TYPE_DOUBLE) emit(OP_DIV);
+            else if (result != TYPE_DOUBLE) emit(op == "/" ? OP_IDIV : OP_MOD, result == TYPE_INT);
+            else {
+                cout << "Error: invalid operands to '%'." << endl;
+                return false;
+            }
+            type = result;
+        }
+        return true;
+    }
+
+    bool expression(ValueType& type) {
+        if (!term(type)) return false;
+        while (peek() == "+" || peek() == "-") {
+            string op = tokens[pos++].second;
+            ValueType right;
+            if (!term(right)) return false;
+            promote(type, right);
+            type = common(type, right);
+            if (type == TYPE_INT) emit(op == "+" ? OP_IADD : OP_ISUB);
+            else if (type == TYPE_LONG) emit(op == "+" ? OP_LADD : OP_LSUB);
+            else emit(op == "+" ? OP_ADD : OP_SUB);
+        }
+        return true;
+    }
+
+    bool store(int slot) {
+        ValueType type;
+        if (!expression(type)) return false;
+        if (!program.slotIsInt[slot]) {
+            if (type != TYPE_DOUBLE) emit(OP_TO_DOUBLE, 0);
+            emit(OP_STORE, slot);
+            return true;
+        }
+        if (type == TYPE_DOUBLE) emit(OP_TRUNC_INT);
+        emit(OP_STORE_INT, slot);
+        return true;
+    }
+
+    bool declaration(const string& type) {
+        do {
+            if (atEnd() || tokens[pos].first != "IDENTIFIER") {
+                cout << "Error: expected a variable name after '" << type << "'." << endl;
+                return false;
+            }
+            string name = tokens[pos++].second;
+            if (slots.count(name) > 0) {
+                cout << "Error: redeclaration of '" << name << "'." << endl;
+                return false;
+            }
+            int slot = (int)program.slotNames.size();
+            slots[name] = slot;
+            program.slotNames.push_back(name);
+            program.slotIsInt.push_back(type == "int");
+            if (accept("=") && !store(slot)) return false;
+        } while (accept(","));
+        return expect(";");
+    }
+
+    bool statement() {
+        string word = peek();
+        if (word == "int" || word == "double" || word == "float") {
+            pos++;
+            return declaration(word);
+        }
+        if (accept("cout")) {
+            if (peek() != "<<") {
+                return expect("<<");
+            }
+            while (accept("<<")) {
+                if (!atEnd() && tokens[pos].first == "STRING") {
+                    program.strings.push_back(tokens[pos++].second);
+                    emit(OP_PRINT_STR, (int)program.strings.size() - 1);
+                }
+                else if (accept("endl")) {
+                    program.strings.push_back("\n");
+                    emit(OP_PRINT_STR, (int)program.strings.size() - 1);
+                }
+                else {
+                    ValueType type;
+                    if (!expression(type)) return false;
+                    emit(type == TYPE_DOUBLE ? OP_PRINT : OP_PRINT_INT);
+                }
+            }
+            return expect(";");
+        }
+        if (accept("cin")) {
+            if (peek() != ">>") {
+                return expect(">>");
+            }
+            while (accept(">>")) {
+                int slot;
+                if (atEnd() || tokens[pos].first != "IDENTIFIER") {
+                    cout << "Error: expected a variable name after '>>' but found '" << found() << "'." << endl;
+                    return false;
+                }
+                if (!lookup(tokens[pos].second, slot)) return false;
+                pos++;
+                emit(program.slotIsInt[slot] ? OP_READ_INT : OP_READ, slot);
+            }
+            return expect(";");
+        }
+        if (accept("return")) {
+            ValueType type;
+            if (!expression(type)) return false;
+            if (type == TYPE_DOUBLE) emit(OP_TRUNC_INT);
+            emit(OP_HALT);
+            return expect(";");
+        }
+        if (!atEnd() && tokens[pos].first == "IDENTIFIER" && pos + 1 < tokens.size() && tokens[pos + 1].first == "SYMBOL" && tokens[pos + 1].second == "=") {
+            int slot;
+            if (!lookup(tokens[pos].second, slot)) return false;
+            pos += 2;
+            return store(slot) && expect(";");
+        }
+        cout << "Error: unsupported statement starting at '" << found() << "'." << endl;
+        return false;
+    }
+
+    bool compile() {
+        if (accept("using")) {
+            if (!expect("namespace") || !expect("std") || !expect(";")) return false;
+        }
+        if (!(accept("int") || accept("void")) || !expect("main") || !expect("(") || !expect(")") || !expect("{")) {
+            cout << "Error: only a single main() function can be executed." << endl;
+            return false;
+        }
+        while (!atEnd() && peek() != "}") {
+            if (cancelRequested) return false;
+            analysisProgress = pos;
+            tokens.release(pos);
+            if (!statement()) return false;
+        }
+        if (!expect("}")) return false;
+        if (!atEnd()) {
+            cout << "Error: unexpected tokens after main()." << endl;
+            return false;
+        }
+        emit(OP_PUSH, constant(0LL));
+        emit(OP_HALT);
+        return true;
+    }
+};
+
+
+bool compileProgram(string filename, Bytecode& program) {
+
+    TokenStream tokens;
+    if (!tokenizeProgram(filename, tokens)) {
+        return false;
+    }
+
+    analysisProgress = 0;
+    analysisTotal = tokens.size();
+    ProgramCompiler compiler(tokens, program);
+    bool compiled = compiler.compile();
+    if (tokens.failed) {
+        cout << "Error: unable to use the spill file for the token stream." << endl;
+        return false;
+    }
+    return compiled;
+}
+
+
+// Reduces an integer to 32 bits the way g++ converts long to int.
+static long long wrapInt32(long long value) {
+    return (int32_t)(uint32_t)(unsigned long long)value;
+}
+
+// 64-bit arithmetic for long values. Each returns false instead of
+// overflowing, which would be undefined behaviour.
+static bool addLong(long long left, long long right, long long& result) {
+    if ((right > 0 && left > LLONG_MAX - right) || (right < 0 && left < LLONG_MIN - right)) return false;
+    result = left + right;
+    return true;
+}
+
+static bool subtractLong(long long left, long long right, long long& result) {
+    if ((right < 0 && left > LLONG_MAX + right) || (right > 0 && left < LLONG_MIN + right)) return false;
+    result = left - right;
+    return true;
+}
+
+static bool multiplyLong(long long left, long long right, long long& result) {
+    if (left == 0 || right == 0) {
+        result = 0;
+        return true;
+    }
+    if ((left == -1 && right == LLONG_MIN) || (right == -1 && left == LLONG_MIN)) return false;
+    long long product = (long long)((unsigned long long)left * (unsigned long long)right);
+    if (product / right != left) return false;
+    result = product;
+    return true;
+}
+
+
+static void appendNumber(string& out, double value) {
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%g", value);
+    out += buffer;
+}
+
+static void appendNumber(string& out, long long value) {
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%lld", value);
+    out += buffer;
+}
+
+
+// Executes the program and returns its exit code. Output is collected in a
+// buffer that is written to sink before every read, once it grows past 64 KB
+// and at exit. A null sink discards the output (used by the benchmark).
+long long runBytecode(const Bytecode& program, istream& in, ostream* sink, long long& executed) {
+
+    vector<Value> slots(program.slotNames.size());
+    vector<Value> stackMemory(program.maxStack + 1);
+    for (size_t i = 0; i < slots.size(); i++) {
+        if (program.slotIsInt[i]) slots[i].i = 0;
+        else slots[i].d = 0;
+    }
+    Value* sp = stackMemory.data();
+    Value* vars = slots.data();
+    const Value* constants = program.constants.data();
+    const Instruction* pc = program.code.data();
+    const Instruction* ip;
+    string out;
+    long long count = 0;
+    long long exitCode = 0;
+
+    auto flush = [&]() {
+        if (sink) sink->write(out.data(), out.size());
+        out.clear();
+    };
+
+#define VM_ERROR(message) do { out += "\nError: " message; exitCode = -1; goto halt; } while (0)
+
+#ifdef PL_COMPUTED_GOTO
+    // Labels as values are a GNU extension, -Wpedantic reports every use.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+    static void* const dispatchTable[] = {
+        &&L_OP_PUSH, &&L_OP_LOAD, &&L_OP_STORE, &&L_OP_STORE_INT, &&L_OP_TRUNC_INT, &&L_OP_TO_DOUBLE, &&L_OP_ADD,
+        &&L_OP_SUB, &&L_OP_MUL, &&L_OP_DIV, &&L_OP_IDIV, &&L_OP_MOD, &&L_OP_NEG, &&L_OP_IADD, &&L_OP_ISUB,
+        &&L_OP_IMUL, &&L_OP_INEG, &&L_OP_LADD, &&L_OP_LSUB, &&L_OP_LMUL, &&L_OP_LNEG, &&L_OP_PRINT,
+        &&L_OP_PRINT_INT, &&L_OP_PRINT_STR, &&L_OP_READ, &&L_OP_READ_INT, &&L_OP_HALT
+    };
+#define VM_CASE(name) L_##name:
+#define VM_NEXT() do { ip = pc++; count++; goto *dispatchTable[ip->op]; } while (0)
+    VM_NEXT();
+#else
+#define VM_CASE(name) case name:
+#define VM_NEXT() break
+    for (;;) {
+        ip = pc++;
+        count++;
+        switch (ip->op) {
+#endif
+
+    VM_CASE(OP_PUSH) *sp++ = constants[ip->operand]; VM_NEXT();
+    VM_CASE(OP_LOAD) *sp++ = vars[ip->operand]; VM_NEXT();
+    VM_CASE(OP_STORE) vars[ip->operand] = *--sp; VM_NEXT();
+    VM_CASE(OP_STORE_INT) sp--; vars[ip->operand].i = wrapInt32(sp[0].i); VM_NEXT();
+    VM_CASE(OP_TRUNC_INT)
+        if (!(sp[-1].d > -2147483649.0 && sp[-1].d < 2147483648.0)) VM_ERROR("value out of range for int.");
+        sp[-1].i = (int32_t)sp[-1].d;
+        VM_NEXT();
+    VM_CASE(OP_TO_DOUBLE) sp[-1 - ip->operand].d = (double)sp[-1 - ip->operand].i; VM_NEXT();
+    VM_CASE(OP_ADD) sp--; sp[-1].d += sp[0].d; VM_NEXT();
+    VM_CASE(OP_SUB) sp--; sp[-1].d -= sp[0].d; VM_NEXT();
+    VM_CASE(OP_MUL) sp--; sp[-1].d *= sp[0].d; VM_NEXT();
+    VM_CASE(OP_DIV) sp--; sp[-1].d /= sp[0].d; VM_NEXT();
+    VM_CASE(OP_IDIV)
+        sp--;
+        if (sp[0].i == 0) VM_ERROR("integer division by zero.");
+        if (sp[0].i == -1 && sp[-1].i == (ip->operand ? INT32_MIN : LLONG_MIN)) VM_ERROR("integer overflow.");
+        sp[-1].i /= sp[0].i;
+        VM_NEXT();
+    VM_CASE(OP_MOD)
+        sp--;
+        if (sp[0].i == 0) VM_ERROR("integer division by zero.");
+        if (sp[0].i == -1 && sp[-1].i == (ip->operand ? INT32_MIN : LLONG_MIN)) VM_ERROR("integer overflow.");
+        sp[-1].i %= sp[0].i;
+        VM_NEXT();
+    VM_CASE(OP_NEG) sp[-1].d = -sp[-1].d; VM_NEXT();
+    // Operands of the int instructions are always 32-bit values, so the
+    // 64-bit intermediate results cannot overflow.
+    VM_CASE(OP_IADD) sp--; sp[-1].i = wrapInt32(sp[-1].i + sp[0].i); VM_NEXT();
+    VM_CASE(OP_ISUB) sp--; sp[-1].i = wrapInt32(sp[-1].i - sp[0].i); VM_NEXT();
+    VM_CASE(OP_IMUL) sp--; sp[-1].i = wrapInt32(sp[-1].i * sp[0].i); VM_NEXT();
+    VM_CASE(OP_INEG) sp[-1].i = wrapInt32(-sp[-1].i); VM_NEXT();
+    VM_CASE(OP_LADD) sp--; if (!addLong(sp[-1].i, sp[0].i, sp[-1].i)) VM_ERROR("integer overflow."); VM_NEXT();
+    VM_CASE(OP_LSUB) sp--; if (!subtractLong(sp[-1].i, sp[0].i, sp[-1].i)) VM_ERROR("integer overflow."); VM_NEXT();
+    VM_CASE(OP_LMUL) sp--; if (!multiplyLong(sp[-1].i, sp[0].i, sp[-1].i)) VM_ERROR("integer overflow."); VM_NEXT();
+    VM_CASE(OP_LNEG)
+        if (sp[-1].i == LLONG_MIN) VM_ERROR("integer overflow.");
+        sp[-1].i = -sp[-1].i;
+        VM_NEXT();
+    VM_CASE(OP_PRINT) appendNumber(out, (--sp)->d); if (out.size() > 65536) flush(); VM_NEXT();
+    VM_CASE(OP_PRINT_INT) appendNumber(out, (--sp)->i); if (out.size() > 65536) flush(); VM_NEXT();
+    VM_CASE(OP_PRINT_STR) out += program.strings[ip->operand]; if (out.size() > 65536) flush(); VM_NEXT();
+    VM_CASE(OP_READ) {
+        double value = 0;
+        flush();
+        if (sink) sink->flush();
+        in >> value;
+        vars[ip->operand].d = value;
+        VM_NEXT();
+    }
+    VM_CASE(OP_READ_INT) {
+        int value = 0;
+        flush();
+        if (sink) sink->flush();
+        in >> value;
+        vars[ip->operand].i = value;
+        VM_NEXT();
+    }
+    VM_CASE(OP_HALT)
+        sp--;
+        exitCode = wrapInt32(sp[0].i);
+        goto halt;
+
+#ifndef PL_COMPUTED_GOTO
+        }
+    }
+#endif
+#ifdef PL_COMPUTED_GOTO
+#pragma GCC diagnostic pop
+#endif
+#undef VM_CASE
+#undef VM_NEXT
+#undef VM_ERROR
+
+halt:
+    flush();
+    executed += count;
+    return exitCode;
+}
+
+
+// Quotes an argument for the command line run by system(). Returns false
+// when it contains characters that cannot be quoted for cmd.exe.
+static bool shellQuote(const string& argument, string& quoted) {
+#ifdef _WIN32
+    if (argument.find_first_of("\"%!^\r\n") != string::npos) return false;
+    quoted = "\"" + argument + "\"";
+#else
+    if (argument.find_first_of("\r\n") != string::npos) return false;
+    quoted = "'";
+    for (char c : argument) {
+        if (c == '\'') quoted += "'\\''";
+        else quoted += c;
+    }
+    quoted += "'";
+#endif
+    return true;
+}
+
+
+void benchmarkFile() {
+    clearScreen();
+    string filename = "";
+    int runs = 0;
+    cout << "=============================================================================" << endl;
+    cout << setw(60) << "C++ Lexical, Syntax, and Semantic Analysis" << endl;
+    cout << "=============================================================================" << endl << endl;
+
+    cout << " Enter filename (ex. \"source.cpp\"): ";
+    getline(cin, filename, '\n');
+    cout << " Enter number of runs: ";
+    cin >> runs;
+    cin.ignore();
+    if (runs < 1) runs = 1;
+
+    cout << endl << "=============================================================================" << endl;
+    cout << setw(51) << " Benchmark: Bytecode vs g++" << endl;
+    cout << "=============================================================================" << endl << endl;
+
+    // Programs that read from cin get zeros, same as the native run below.
+    auto start = chrono::steady_clock::now();
+    Bytecode program;
+    if (!compileProgram(filename, program)) {
+        pressEnter();
+        return;
+    }
+    double compileSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    long long executed = 0;
+    start = chrono::steady_clock::now();
+    for (int i = 0; i < runs; i++) {
+        istringstream noInput("");
+        runBytecode(program, noInput, nullptr, executed);
+    }
+    double runSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    cout << fixed << setprecision(3);
+    cout << "[Bytecode Interpreter]" << endl << endl;
+    cout << " Compile time:        " << compileSeconds * 1000 << " ms (" << program.code.size() << " instructions)" << endl;
+    cout << " Total run time:      " << runSeconds * 1000 << " ms for " << runs << " runs" << endl;
+    cout << " Instructions/second: " << setprecision(0) << (runSeconds > 0 ? executed / runSeconds : 0) << endl;
+    cout << setprecision(3);
+
+    error_code error;
+    filesystem::path directory = filesystem::temp_directory_path(error);
+    if (error) directory = ".";
+    string nativeExe = (directory / ("pl_bench_native_" + to_string(chrono::steady_clock::now().time_since_epoch().count()))).string();
+#ifdef _WIN32
+    nativeExe += ".exe";
+    const string nullDevice = "NUL";
+#else
+    const string nullDevice = "/dev/null";
+#endif
+
+    cout << endl << "[System Compiler]" << endl << endl;
+    string quotedFile;
+    string quotedExe;
+    if (!shellQuote(filename, quotedFile) || !shellQuote(nativeExe, quotedExe)) {
+        cout << " The filename contains characters that cannot be passed to g++ safely." << endl;
+    }
+    else {
+        string compileCommand = "g++ -O2 -o " + quotedExe + " " + quotedFile + " > " + nullDevice + " 2>&1";
+        string runCommand = quotedExe + " < " + nullDevice + " > " + nullDevice;
+
+        start = chrono::steady_clock::now();
+        int status = system(compileCommand.c_str());
+        double nativeCompileSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        if (status != 0) {
+            cout << " g++ is not available or failed to compile the file." << endl;
+        }
+        else {
+            // Every run goes through system(), so time the same number of empty
+            // shell commands and subtract them from the native run time.
+            start = chrono::steady_clock::now();
+            for (int i = 0; i < runs; i++) {
+                if (system("exit 0") == -1) break;
+            }
+            double shellSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+            start = chrono::steady_clock::now();
+            for (int i = 0; i < runs; i++) {
+                if (system(runCommand.c_str()) == -1) break;
+            }
+            double nativeRunSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            nativeRunSeconds = max(0.0, nativeRunSeconds - shellSeconds);
+            remove(nativeExe.c_str());
+
+            double bytecodeTotal = compileSeconds + runSeconds;
+            double nativeTotal = nativeCompileSeconds + nativeRunSeconds;
+            cout << " Compile time:        " << nativeCompileSeconds * 1000 << " ms" << endl;
+            cout << " Total run time:      " << nativeRunSeconds * 1000 << " ms for " << runs << " runs" << endl;
+            cout << " Shell start-up:      " << shellSeconds * 1000 << " ms (subtracted from run time)" << endl << endl;
+            cout << " Compile + run, bytecode: " << bytecodeTotal * 1000 << " ms" << endl;
+            cout << " Compile + run, g++:      " << nativeTotal * 1000 << " ms";
+            if (bytecodeTotal > 0) cout << " (" << setprecision(1) << nativeTotal / bytecodeTotal << "x)";
+            cout << endl;
+        }
+    }
+    cout.unsetf(ios::floatfield);
+    cout << setprecision(6);
+
+    cout << endl << "=============================================================================" << endl << endl;
+    cout << " Press <Enter> to continue...";
+    cin.get();
+}
+
+
 void inputFile() {
-    system("cls");
+    clearScreen();
     string filename = "";
     cout << "=============================================================================" << endl;
     cout << setw(60) << "C++ Lexical, Syntax, and Semantic Analysis" << endl;
@@ -483,9 +1866,10 @@ void inputFile() {
     cout << " Enter filename (ex. \"source.cpp\"): ";
     getline(cin, filename, '\n');
 
-    if (lexicalAnalysis(filename) && syntaxAnalysis() && semanticAnalysis(filename));
+    runAnalysis(filename);
    
     cout << endl << "=============================================================================" << endl << endl;
+    printMemoryReport();
 
     cout << " Press <Enter> to continue...";
     cin.get();
@@ -493,7 +1877,7 @@ void inputFile() {
 
 
 void inputText() {
-    system("cls");
+    clearScreen();
     string code = "";
     cout << "=============================================================================" << endl;
     cout << setw(60) << "C++ Lexical, Syntax, and Semantic Analysis" << endl;
@@ -514,12 +1898,13 @@ void inputText() {
         cout << line << endl;
     }
     outputFile.close();
-    system("cls");
+    clearScreen();
 
 
-    if (lexicalAnalysis("inputText.txt") && syntaxAnalysis() && semanticAnalysis("inputText.txt"));
+    runAnalysis("inputText.txt");
    
     cout << endl << "=============================================================================" << endl << endl;
+    printMemoryReport();
 
     cout << " Press <Enter> to continue...";
     cin.get();
@@ -600,15 +1985,226 @@ Node* createParseTree(const vector<pair<string, pair<string, string>>>& input) {
     return root;
 }
 
+// Visits every node with its depth, parents before children. Uses an explicit
+// stack so that arbitrarily deep trees cannot overflow the call stack.
+void preOrderTraversal(Node* root, const function<void(Node*, int)>& visit, int depth) {
+    if (root == nullptr) return;
+    stack<pair<Node*, int>> pending;
+    pending.push({ root, depth });
+    while (!pending.empty()) {
+        Node* node = pending.top().first;
+        int level = pending.top().second;
+        pending.pop();
+        visit(node, level);
+        for (auto it = node->children.rbegin(); it != node->children.rend(); ++it) {
+            pending.push({ *it, level + 1 });
+        }
+    }
+}
+
+// Visits every node with its depth, children before parents, so the visitor
+// may safely delete the node it is given.
+void postOrderTraversal(Node* root, const function<void(Node*, int)>& visit, int depth) {
+    if (root == nullptr) return;
+    struct Frame {
+        Node* node;
+        int depth;
+        size_t next;
+    };
+    stack<Frame> pending;
+    pending.push({ root, depth, 0 });
+    while (!pending.empty()) {
+        Frame& frame = pending.top();
+        if (frame.next < frame.node->children.size()) {
+            Node* child = frame.node->children[frame.next++];
+            pending.push({ child, frame.depth + 1, 0 });
+        }
+        else {
+            Node* node = frame.node;
+            int level = frame.depth;
+            pending.pop();
+            visit(node, level);
+        }
+    }
+}
+
 void printParseTree(Node* node, int depth = 0) {
-    for (int i = 0; i < depth; ++i) cout << "  ";
-    cout << node->value << endl;
-    for (const auto& child : node->children) {
-        printParseTree(child, depth + 1);
+    // Lines are assembled in one buffer and written in large chunks instead
+    // of one stream insertion and flush per line.
+    const size_t chunkSize = 1 << 20;
+    string out;
+    string indent;
+    out.reserve(chunkSize + 4096);
+    preOrderTraversal(node, [&](Node* current, int level) {
+        size_t width = 2 * (size_t)level;
+        if (indent.length() < width) indent.append(width - indent.length(), ' ');
+        out.append(indent, 0, width);
+        out += current->value;
+        out += '\n';
+        if (out.length() >= chunkSize) {
+            cout.write(out.data(), out.length());
+            out.clear();
+        }
+    }, depth);
+    cout.write(out.data(), out.length());
+    cout.flush();
+}
+
+
+
+
+void deleteParseTree(Node* root) {
+    postOrderTraversal(root, [](Node* node, int) { delete node; });
+}
+
+
+void setMemoryBudget() {
+    long long megabytes = 0;
+    // Only the token stream of the Phase 4 compiler is kept within the
+    // budget; phases 1-3 still hold their tokens and symbol table in memory.
+    cout << " The budget limits the tokens the Phase 4 compiler keeps in memory." << endl;
+    cout << " Enter memory budget in MB (0 for unlimited): ";
+    cin >> megabytes;
+    cin.ignore();
+    memoryBudget = megabytes > 0 ? (size_t)megabytes * 1024 * 1024 : 0;
+}
+
+
+// Peak resident set size of the process in bytes, 0 if unavailable.
+size_t peakMemoryUsage() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return counters.PeakWorkingSetSize;
     }
+    return 0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+    return (size_t)usage.ru_maxrss;
+#else
+    return (size_t)usage.ru_maxrss * 1024;
+#endif
+#endif
 }
 
 
+void printMemoryReport() {
+    cout << fixed << setprecision(1);
+    cout << " Peak memory usage: " << peakMemoryUsage() / (1024.0 * 1024.0) << " MB";
+    if (memoryBudget > 0) {
+        cout << " (budget: " << memoryBudget / (1024 * 1024) << " MB, spilled to disk: " << spilledBytes / 1024.0 << " KB)";
+    }
+    cout << endl << endl;
+    cout.unsetf(ios::floatfield);
+    cout << setprecision(6);
+}
+
+
+bool stdoutIsTerminal() {
+#ifdef _WIN32
+    return _isatty(_fileno(stdout)) != 0;
+#else
+    return isatty(STDOUT_FILENO) != 0;
+#endif
+}
+
+
+// Runs phases 1-3 and the compilation of phase 4 on a worker thread while
+// this thread shows the progress of the current phase and polls for 'c' or
+// Esc to cancel; Ctrl-C cancels too. The program reads from cin, so it runs
+// here once the worker has finished.
+bool runAnalysis(string filename) {
+
+    error_code error;
+    uintmax_t fileSize = filesystem::file_size(filename, error);
+    if (error) fileSize = 0;
+
+    spilledBytes = 0;
+    cancelRequested = false;
+    analysisPhase = 1;
+    analysisProgress = 0;
+    analysisTotal = fileSize;
+    atomic<bool> done(false);
+    bool passed = false;
+    Bytecode program;
+    bool interactive = stdoutIsTerminal();
+
+    cout.flush();
+    {
+        ConsoleBuffer console(cout.rdbuf());
+        streambuf* original = cout.rdbuf(&console);
+        KeyboardPoller keyboard;
+
+        thread worker([&]() {
+            bool ok = lexicalAnalysis(filename);
+            if (ok) {
+                analysisPhase = 2;
+                ok = syntaxAnalysis();
+            }
+            if (ok) {
+                // Phase 3 reads the file twice
+                analysisProgress = 0;
+                analysisTotal = fileSize * 2;
+                analysisPhase = 3;
+                ok = semanticAnalysis(filename);
+            }
+            if (ok) {
+                analysisProgress = 0;
+                analysisTotal = fileSize;
+                analysisPhase = 4;
+                ok = programCompilation(filename, program);
+            }
+            cout.flush();
+            passed = ok;
+            done = true;
+        });
+
+        const char* phaseNames[] = { "", "Lexical Analysis", "Syntax Analysis", "Semantic Analysis", "Execution" };
+        while (!done) {
+            int key = keyboard.poll(100);
+            if (key == 'c' || key == 'C' || key == 27) {
+                cancelRequested = true;
+            }
+            if (interactive && !done) {
+                int phase = analysisPhase;
+                double total = (double)analysisTotal;
+                double percent = total > 0 ? min(100.0, 100.0 * analysisProgress / total) : 0;
+                ostringstream status;
+                status << " [Phase " << phase << "/4: " << phaseNames[phase] << "] ";
+                if (phase != 2) status << fixed << setprecision(0) << percent << "% ";
+                status << (cancelRequested ? "cancelling..." : "press 'c' or Ctrl-C to cancel");
+                console.showStatus(status.str());
+            }
+        }
+        worker.join();
+        cout.rdbuf(original);
+    }
+
+    if (cancelRequested) {
+        cancelRequested = false;
+        cout << endl << " Analysis cancelled." << endl;
+        return false;
+    }
+    return passed && programExecution(program);
+}
+
+
+void clearScreen() {
+#ifdef _WIN32
+    static bool enabled = false;
+    if (!enabled) {
+        HANDLE console = GetStdHandle(STD_OUTPUT_HANDLE);
+        DWORD mode = 0;
+        if (GetConsoleMode(console, &mode)) SetConsoleMode(console, mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING);
+        enabled = true;
+    }
+#endif
+    if (stdoutIsTerminal()) {
+        cout << "\x1b[2J\x1b[H" << flush;
+    }
+}
 
 
 void pressEnter() {
@@ -0,0 +1,138 @@
+// Fuzzing and differential-testing harness for the analysis phases.
+//
+// libFuzzer (clang):
+//   clang++ -std=c++17 -g -O1 -fsanitize=fuzzer,address,undefined fuzz_analysis.cpp -o fuzz_analysis
+//   ./fuzz_analysis corpus/ source.cpp inputText.txt
+//
+// Standalone replay of files (any compiler):
+//   g++ -std=c++17 -O2 -DPL_FUZZ_STANDALONE fuzz_analysis.cpp -o fuzz_analysis
+//   ./fuzz_analysis source.cpp inputText.txt
+//
+// Every input is run through the lexer, the parser and the semantic checker.
+// scanTokenizeLine() is compared against the regex-based regexTokenizeLine()
+// line by line, and the full lexicalAnalysis() output of both engines must
+// match; any difference aborts with both token lists. The slowest input seen
+// so far for each phase is saved as worst_<phase>.txt.
+
+#define PL_NO_MAIN
+#include "PL_FINAL.cpp"
+
+#include <cstdint>
+
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+
+static string fuzzInputFile() {
+    static string name = "fuzz_input_" + to_string(getpid()) + ".txt";
+    return name;
+}
+
+
+static void printLexemes(const char* engine, const vector<pair<size_t, string>>& lexemes) {
+    cerr << engine << ":";
+    for (const auto& lexeme : lexemes) {
+        cerr << " [" << lexeme.first << ":" << lexeme.second << "]";
+    }
+    cerr << endl;
+}
+
+
+// Runs one phase with cout discarded, records the input if it is the slowest
+// seen for that phase and returns the phase output.
+template <typename Phase>
+static string timePhase(const char* name, const uint8_t* data, size_t size, Phase phase) {
+    static map<string, double> worstSeconds;
+
+    ostringstream captured;
+    streambuf* original = cout.rdbuf(captured.rdbuf());
+    auto start = chrono::steady_clock::now();
+    phase();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout.rdbuf(original);
+
+    if (seconds > worstSeconds[name]) {
+        worstSeconds[name] = seconds;
+        ofstream worst(string("worst_") + name + ".txt", ios::binary | ios::trunc);
+        worst.write((const char*)data, size);
+        if (seconds > 0.1) {
+            cerr << "Slow input for " << name << ": " << fixed << setprecision(3) << seconds * 1000 << " ms" << endl;
+        }
+    }
+    return captured.str();
+}
+
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+
+    string text((const char*)data, size);
+    string filename = fuzzInputFile();
+    {
+        ofstream file(filename, ios::binary | ios::trunc);
+        file.write(text.data(), text.size());
+    }
+
+    // Differential check of the tokenizers, line by line as getline() splits them.
+    istringstream lines(text);
+    string line;
+    while (getline(lines, line)) {
+        vector<pair<size_t, string>> expected = regexTokenizeLine(line);
+        vector<pair<size_t, string>> actual = scanTokenizeLine(line);
+        if (expected != actual) {
+            cerr << "Tokenizer mismatch on line: \"" << line << "\"" << endl;
+            printLexemes("regex", expected);
+            printLexemes("scanner", actual);
+            abort();
+        }
+    }
+
+    bool regexResult = false;
+    bool scannerResult = false;
+    string regexOutput = timePhase("lexical", data, size, [&]() { regexResult = lexicalAnalysis(filename); });
+    string scannerOutput = timePhase("lexical_scanner", data, size, [&]() { scannerResult = lexicalAnalysis(filename, true); });
+    if (regexResult != scannerResult || regexOutput != scannerOutput) {
+        cerr << "lexicalAnalysis() output differs between engines." << endl;
+        cerr << "--- regex ---" << endl << regexOutput << endl;
+        cerr << "--- scanner ---" << endl << scannerOutput << endl;
+        abort();
+    }
+
+    timePhase("syntax", data, size, []() { syntaxAnalysis(); });
+
+    symbolList.clear();
+    timePhase("semantic", data, size, [&]() { semanticAnalysis(filename); });
+
+    timePhase("execution", data, size, [&]() {
+        Bytecode program;
+        if (compileProgram(filename, program)) {
+            istringstream noInput("");
+            long long executed = 0;
+            runBytecode(program, noInput, nullptr, executed);
+        }
+    });
+
+    remove(filename.c_str());
+    return 0;
+}
+
+
+#ifdef PL_FUZZ_STANDALONE
+int main(int argc, char** argv) {
+
+    for (int i = 1; i < argc; i++) {
+        ifstream file(argv[i], ios::binary);
+        if (!file.is_open()) {
+            cerr << "Error: Unable to open " << argv[i] << endl;
+            return 1;
+        }
+        string data((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+        LLVMFuzzerTestOneInput((const uint8_t*)data.data(), data.size());
+        cerr << argv[i] << ": ok" << endl;
+    }
+    return 0;
+}
+#endif